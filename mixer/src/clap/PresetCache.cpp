@@ -0,0 +1,353 @@
+/*******************************************************************************/
+/* This file is part of Non-Mixer-XT                                           */
+/*                                                                             */
+/* This program is free software; you can redistribute it and/or modify it     */
+/* under the terms of the GNU General Public License as published by the       */
+/* Free Software Foundation; either version 2 of the License, or (at your      */
+/* option) any later version.                                                  */
+/*                                                                             */
+/* This program is distributed in the hope that it will be useful, but WITHOUT */
+/* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       */
+/* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for   */
+/* more details.                                                               */
+/*                                                                             */
+/* You should have received a copy of the GNU General Public License along     */
+/* with This program; see the file COPYING.  If not,write to the Free Software */
+/* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.  */
+/*******************************************************************************/
+
+#ifdef CLAP_SUPPORT
+
+#include "PresetCache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+#include <system_error>
+#include "../../../nonlib/debug.h"
+#include "../FNV_Hash.H"
+
+namespace fs = std::filesystem;
+
+extern char *user_config_dir;
+
+static const char* const CLAP_PRESET_CACHE_DIR = "clap_presets";
+
+// Guards PresetCache::entries() and g_id_locks
+static std::mutex g_entries_lock;
+static std::map<std::string, std::mutex> g_id_locks;
+
+/* ---------- helpers ---------- */
+
+// Fields are tab separated, one record per line
+static std::string escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+
+    for (char c : s) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '\t': out += "\\t"; break;
+            case '\n': out += "\\n"; break;
+            default: out += c; break;
+        }
+    }
+
+    return out;
+}
+
+static std::string unescape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 == s.size()) {
+            out += s[i];
+            continue;
+        }
+
+        switch (s[++i]) {
+            case 't': out += '\t'; break;
+            case 'n': out += '\n'; break;
+            default: out += s[i]; break;
+        }
+    }
+
+    return out;
+}
+
+static std::vector<std::string> split(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string::size_type start = 0;
+
+    for (;;) {
+        std::string::size_type tab = line.find('\t', start);
+        fields.push_back(unescape(line.substr(start, tab - start)));
+
+        if (tab == std::string::npos)
+            break;
+
+        start = tab + 1;
+    }
+
+    return fields;
+}
+
+/* ---------- public ---------- */
+
+std::map<std::string, std::shared_ptr<const PresetCache::Entry>>&
+PresetCache::entries() {
+    static std::map<std::string, std::shared_ptr<const Entry>> entries;
+    return entries;
+}
+
+std::mutex& PresetCache::lock(const std::string& plugin_id) {
+    std::lock_guard<std::mutex> guard(g_entries_lock);
+
+    return g_id_locks[plugin_id];
+}
+
+bool PresetCache::lookup(
+    const std::string& plugin_id,
+    const std::string& plugin_path,
+    std::vector<Preset>& presets) {
+
+    std::shared_ptr<const Entry> entry;
+
+    {
+        std::lock_guard<std::mutex> guard(g_entries_lock);
+
+        auto it = entries().find(plugin_id);
+
+        if (it != entries().end())
+            entry = it->second;
+    }
+
+    const bool in_memory = entry != nullptr;
+
+    if (!in_memory) {
+        auto loaded = std::make_shared<Entry>();
+
+        if (!read(plugin_id, *loaded))
+            return false;
+
+        entry = loaded;
+    }
+
+    if (entry->fingerprint != fingerprint(plugin_path, entry->locations)) {
+        DMESSAGE("Preset files changed for %s", plugin_id.c_str());
+        return false;
+    }
+
+    if (!in_memory) {
+        std::lock_guard<std::mutex> guard(g_entries_lock);
+        entries()[plugin_id] = entry;
+    }
+
+    presets = entry->presets;
+
+    DMESSAGE("Using %s preset index for %s: %u presets",
+             in_memory ? "shared" : "saved",
+             plugin_id.c_str(), (unsigned)presets.size());
+
+    return true;
+}
+
+void PresetCache::store(
+    const std::string& plugin_id,
+    const std::string& plugin_path,
+    const std::vector<fs::path>& locations,
+    const std::vector<Preset>& presets) {
+
+    auto entry = std::make_shared<Entry>();
+
+    entry->locations = locations;
+    entry->presets = presets;
+    entry->fingerprint = fingerprint(plugin_path, locations);
+
+    write(plugin_id, *entry);
+
+    std::lock_guard<std::mutex> guard(g_entries_lock);
+    entries()[plugin_id] = entry;
+}
+
+/* ---------- private ---------- */
+
+/*
+ * Count, total size, newest modification time and a hash of every path,
+ * size and time under the locations, plus the plugin file itself. Only
+ * stat() is used, no preset file is opened.
+ */
+std::string PresetCache::fingerprint(
+    const std::string& plugin_path,
+    const std::vector<fs::path>& locations) {
+
+    uint64_t count = 0;
+    uint64_t total = 0;
+    int64_t newest = 0;
+    uint32_t hash = FNV32_OFFSET;
+
+    auto add = [&](const std::string& path) {
+        struct stat st;
+
+        hash = fnv_continue(hash, path.c_str(), path.size() + 1);
+
+        if (stat(path.c_str(), &st))
+            return;
+
+        const uint64_t size = st.st_size;
+        const int64_t mtime = st.st_mtime;
+
+        hash = fnv_continue(hash, &size, sizeof(size));
+        hash = fnv_continue(hash, &mtime, sizeof(mtime));
+
+        ++count;
+        total += size;
+        newest = std::max(newest, mtime);
+    };
+
+    add(plugin_path);
+
+    std::vector<fs::path> sorted(locations);
+    std::sort(sorted.begin(), sorted.end());
+
+    for (const auto& root : sorted) {
+        std::error_code ec;
+
+        if (!fs::is_directory(root, ec)) {
+            add(root.string());
+            continue;
+        }
+
+        // directory order is not stable, sort before hashing
+        std::vector<std::string> files;
+
+        fs::recursive_directory_iterator it(
+            root,
+            fs::directory_options::skip_permission_denied,
+            ec);
+        fs::recursive_directory_iterator end;
+
+        for (; !ec && it != end; it.increment(ec)) {
+            std::error_code file_ec;
+
+            if (it->is_regular_file(file_ec) && !file_ec)
+                files.push_back(it->path().string());
+        }
+
+        std::sort(files.begin(), files.end());
+
+        for (const auto& f : files)
+            add(f);
+    }
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%llu|%llu|%lld|%08x",
+             (unsigned long long)count, (unsigned long long)total,
+             (long long)newest, hash);
+
+    return buf;
+}
+
+std::string PresetCache::file_name(const std::string& plugin_id) {
+    std::string name;
+
+    for (char c : plugin_id)
+        name += (isalnum((unsigned char)c) || c == '.' || c == '-' || c == '_') ? c : '_';
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".%08x",
+             fnv_continue((uint32_t)FNV32_OFFSET, plugin_id.c_str(), plugin_id.size()));
+
+    return std::string(user_config_dir) + "/" + CLAP_PRESET_CACHE_DIR + "/" + name + suffix;
+}
+
+bool PresetCache::read(const std::string& plugin_id, Entry& entry) {
+    std::ifstream in(file_name(plugin_id));
+
+    if (!in)
+        return false;
+
+    std::string line;
+    Preset* current = nullptr;
+
+    while (std::getline(in, line)) {
+        std::vector<std::string> f = split(line);
+
+        if (f[0] == "id" && f.size() == 2) {
+            // guards against two ids sharing a sanitised name
+            if (f[1] != plugin_id)
+                return false;
+        }
+        else if (f[0] == "fingerprint" && f.size() == 2)
+            entry.fingerprint = f[1];
+        else if (f[0] == "location" && f.size() == 2)
+            entry.locations.emplace_back(f[1]);
+        else if (f[0] == "preset" && f.size() == 5) {
+            entry.presets.emplace_back();
+            current = &entry.presets.back();
+            current->flags = strtoul(f[1].c_str(), nullptr, 10);
+            current->name = f[2];
+            current->location = f[3];
+            current->load_key = f[4];
+        }
+        else if (f[0] == "feature" && f.size() == 2 && current)
+            current->features.push_back(f[1]);
+        else if (f[0] == "creator" && f.size() == 2 && current)
+            current->creators.push_back(f[1]);
+    }
+
+    return !entry.fingerprint.empty();
+}
+
+void PresetCache::write(const std::string& plugin_id, const Entry& entry) {
+    const std::string dir = std::string(user_config_dir) + "/" + CLAP_PRESET_CACHE_DIR;
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    const std::string path = file_name(plugin_id);
+    const std::string temp = path + ".tmp";
+
+    {
+        std::ofstream out(temp, std::ios::trunc);
+
+        if (!out) {
+            WARNING("Could not write %s", temp.c_str());
+            return;
+        }
+
+        out << "id\t" << escape(plugin_id) << "\n";
+        out << "fingerprint\t" << escape(entry.fingerprint) << "\n";
+
+        for (const auto& loc : entry.locations)
+            out << "location\t" << escape(loc.string()) << "\n";
+
+        for (const auto& p : entry.presets) {
+            out << "preset\t" << p.flags << "\t" << escape(p.name) << "\t"
+                << escape(p.location) << "\t" << escape(p.load_key) << "\n";
+
+            for (const auto& feature : p.features)
+                out << "feature\t" << escape(feature) << "\n";
+
+            for (const auto& creator : p.creators)
+                out << "creator\t" << escape(creator) << "\n";
+        }
+
+        if (!out.flush()) {
+            WARNING("Could not write %s", temp.c_str());
+            out.close();
+            remove(temp.c_str());
+            return;
+        }
+    }
+
+    if (rename(temp.c_str(), path.c_str())) {
+        WARNING("Could not write %s", path.c_str());
+        remove(temp.c_str());
+    }
+}
+
+#endif  // CLAP_SUPPORT
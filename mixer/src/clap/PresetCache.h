@@ -0,0 +1,73 @@
+/*******************************************************************************/
+/* This file is part of Non-Mixer-XT                                           */
+/*                                                                             */
+/* This program is free software; you can redistribute it and/or modify it     */
+/* under the terms of the GNU General Public License as published by the       */
+/* Free Software Foundation; either version 2 of the License, or (at your      */
+/* option) any later version.                                                  */
+/*                                                                             */
+/* This program is distributed in the hope that it will be useful, but WITHOUT */
+/* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       */
+/* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for   */
+/* more details.                                                               */
+/*                                                                             */
+/* You should have received a copy of the GNU General Public License along     */
+/* with This program; see the file COPYING.  If not,write to the Free Software */
+/* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.  */
+/*******************************************************************************/
+
+#pragma once
+
+#ifdef CLAP_SUPPORT
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "PresetModel.h"
+
+/*
+ * Preset discovery results per CLAP plugin id, shared in memory by every
+ * instance and kept on disk between sessions. An entry stays valid while
+ * the fingerprint of the plugin file and of the locations its providers
+ * declared is unchanged, so the providers only run again when preset
+ * files are added, removed or modified.
+ */
+class PresetCache {
+public:
+    // Held while an instance looks up or indexes plugin_id, so instances
+    // of the same plugin wait for the first crawl instead of repeating it.
+    static std::mutex& lock(const std::string& plugin_id);
+
+    static bool lookup(const std::string& plugin_id,
+                       const std::string& plugin_path,
+                       std::vector<Preset>& presets);
+
+    static void store(const std::string& plugin_id,
+                      const std::string& plugin_path,
+                      const std::vector<std::filesystem::path>& locations,
+                      const std::vector<Preset>& presets);
+
+private:
+    struct Entry {
+        std::string fingerprint;
+        std::vector<std::filesystem::path> locations;
+        std::vector<Preset> presets;
+    };
+
+    // Published entries are immutable, instances copy the presets out
+    static std::map<std::string, std::shared_ptr<const Entry>>& entries();
+
+    static std::string fingerprint(
+        const std::string& plugin_path,
+        const std::vector<std::filesystem::path>& locations);
+
+    static std::string file_name(const std::string& plugin_id);
+
+    static bool read(const std::string& plugin_id, Entry& entry);
+    static void write(const std::string& plugin_id, const Entry& entry);
+};
+
+#endif  // CLAP_SUPPORT
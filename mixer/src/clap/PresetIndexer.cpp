@@ -48,6 +48,10 @@ const std::vector<Preset>& PresetIndexer::presets() const {
     return receiver_.presets();
 }
 
+const std::vector<fs::path>& PresetIndexer::locations() const {
+    return locations_;
+}
+
 /* ---------- callbacks ---------- */
 
 bool PresetIndexer::declare_filetype(
@@ -33,6 +33,7 @@ public:
     void crawl(const clap_preset_discovery_provider_t* provider);
 
     const std::vector<Preset>& presets() const;
+    const std::vector<std::filesystem::path>& locations() const;
 
 private:
     static bool declare_filetype(
@@ -607,7 +607,7 @@ struct LV2_RDF_Descriptor {
         }
         if (Ports != NULL)
         {
-            ::free((void*)Ports);
+            delete[] Ports;
             Ports = NULL;
         }
         if (Presets != NULL)
@@ -47,6 +47,12 @@
 #include <lv2/lv2plug.in/ns/ext/worker/worker.h>
 
 #include <algorithm>    // sort
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "lv2_external_ui.h"
 #include "lv2_kxstudio_properties.h"
@@ -232,6 +238,24 @@ public:
 
     bool needsInit;
 
+    // One world is shared by the plugin list, the RDF descriptors and every
+    // LV2_Plugin instance. Lilv is not thread safe, so anything that loads
+    // into or queries the world from outside the UI thread takes this lock.
+    mutable std::recursive_mutex worldMutex;
+
+    // Plugin URI -> sorted preset list, filled the first time a plugin is
+    // described so further instances skip the preset resource loads.
+    std::map<std::string, std::vector<LV2_RDF_Preset> > presetCache;
+
+    // Bundle directories loaded one at a time while needsInit is still set
+    std::set<std::string> loadedBundles;
+
+    // Savings report
+    uint32_t worldUsers;
+    uint32_t presetCacheHits;
+    uint32_t snapshotHits;
+    double loadSeconds;
+
     // -------------------------------------------------------------------
 
     Lv2WorldClass()
@@ -349,7 +373,11 @@ public:
           rdf_type           (new_uri(NS_rdf "type")),
           rdfs_label         (new_uri(NS_rdfs "label")),
 
-          needsInit(true)    {}
+          needsInit(true),
+          worldUsers(0),
+          presetCacheHits(0),
+          snapshotHits(0),
+          loadSeconds(0.0)   {}
 
     static Lv2WorldClass& getInstance()
     {
@@ -359,6 +387,8 @@ public:
 
     void initIfNeeded(bool needsRescan)
     {
+        const std::lock_guard<std::recursive_mutex> lock(worldMutex);
+
         // needsRescan is for forced rescan, otherwise we go with previous needsInit
         // which will be set to false after initial scan
         if(needsRescan)
@@ -368,16 +398,44 @@ public:
             return;
 
         needsInit = false;  // don't rescan next call unless needsRescan requested
+
+        const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
         Lilv::World::load_all(/*LV2_PATH*/);
+        loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // A rescan invalidates anything resolved from the old data
+        presetCache.clear();
+    }
+
+    /* Hand the shared world to a plugin instance. Nothing is loaded here,
+       the instance loads either its own bundles or everything. */
+    LilvWorld* acquireWorld()
+    {
+        const std::lock_guard<std::recursive_mutex> lock(worldMutex);
+
+        ++worldUsers;
+
+        return this->me;
     }
 
-    void load_bundle(const char* const bundle)
+    /* Load a single bundle directory, used when the plugin description comes
+       from the LV2 metadata snapshot. A later initIfNeeded() still loads all. */
+    void load_bundle(const char* const bundlePath)
     {
-        if (bundle == NULL || bundle[0] == '\0')
+        if (bundlePath == NULL || bundlePath[0] == '\0')
             return;
 
-        needsInit = false;
-        Lilv::World::load_bundle(Lilv::Node(new_uri(bundle)));
+        const std::lock_guard<std::recursive_mutex> lock(worldMutex);
+
+        if (!needsInit || !loadedBundles.insert(bundlePath).second)
+            return; // already loaded
+
+        Lilv::World::load_bundle(Lilv::Node(new_file_uri(NULL, bundlePath)));
+    }
+
+    bool hasData() const
+    {
+        return !needsInit || !loadedBundles.empty();
     }
 
     uint getPluginCount() const
@@ -413,7 +471,7 @@ public:
 
     const LilvPlugin* getPluginFromURI(const LV2_URI uri) const
     {
-        if (uri == NULL || uri[0] == '\0' || needsInit)
+        if (uri == NULL || uri[0] == '\0' || !hasData())
             return NULL;
 
         if (const LilvPlugins* const cPlugins = lilv_world_get_all_plugins(this->me))
@@ -432,9 +490,11 @@ public:
     /* requires custom lilv */
     LilvState* getStateFromURI(const LV2_URI uri,  LV2_URID_Map* const uridMap) const
     {
-        if (uri == NULL || uri[0] == '\0' || uridMap == NULL || needsInit)
+        if (uri == NULL || uri[0] == '\0' || uridMap == NULL || !hasData())
             return NULL;
 
+        const std::lock_guard<std::recursive_mutex> lock(worldMutex);
+
         if (LilvNode* const uriNode = lilv_new_uri(this->me, uri))
         {
             LilvState* const cState(lilv_state_new_from_world(this->me, uridMap, uriNode));
@@ -458,6 +518,8 @@ const LV2_RDF_Descriptor* lv2_rdf_new(const LV2_URI uri, const bool loadPresets)
 
     Lv2WorldClass& lv2World(Lv2WorldClass::getInstance());
 
+    const std::lock_guard<std::recursive_mutex> lock(lv2World.worldMutex);
+
     const LilvPlugin* const cPlugin(lv2World.getPluginFromURI(uri));
     if (cPlugin == NULL) return NULL;
 
@@ -1089,7 +1151,18 @@ const LV2_RDF_Descriptor* lv2_rdf_new(const LV2_URI uri, const bool loadPresets)
         }
     }
 
+    // Presets are resolved once per plugin URI, later instances copy the list
+    std::map<std::string, std::vector<LV2_RDF_Preset> >::const_iterator cachedPresets(lv2World.presetCache.end());
+
     if (loadPresets)
+        cachedPresets = lv2World.presetCache.find(uri);
+
+    if (loadPresets && cachedPresets != lv2World.presetCache.end())
+    {
+        rdfDescriptor->PresetListStructs = cachedPresets->second;
+        ++lv2World.presetCacheHits;
+    }
+    else if (loadPresets)
     {
         Lilv::Nodes presetNodes(lilvPlugin.get_related(lv2World.preset_preset));
 
@@ -1166,6 +1239,8 @@ const LV2_RDF_Descriptor* lv2_rdf_new(const LV2_URI uri, const bool loadPresets)
         }
 
         lilv_nodes_free(const_cast<LilvNodes*>(presetNodes.me));
+
+        lv2World.presetCache[uri] = rdfDescriptor->PresetListStructs;
     }
 
 #if 0